@@ -29,7 +29,8 @@ MAK_SWITCH=$(SW_PREFIX)$(DEF_REVISION)
 
 MAK_LIBS=
 
-MAK_INCL=$(MEN_INC_DIR)/../../NATIVE/MEN/men_chameleon.h 
+MAK_INCL=$(MEN_INC_DIR)/../../NATIVE/MEN/men_chameleon.h \
+		 $(MEN_MOD_DIR)/men_z25_tt.h
 
 MAK_INP1=men_z25_serial$(INP_SUFFIX)
 
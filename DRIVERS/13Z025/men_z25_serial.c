@@ -31,13 +31,32 @@
 #include <linux/module.h>
 #include <linux/ioport.h>
 #include <linux/init.h>
-#include <linux/serial.h>
+#include <linux/slab.h>
+#include <linux/mutex.h>
+#include <linux/pci.h>
+#include <linux/sched.h>
+#include <linux/kthread.h>
+#include <linux/cpumask.h>
+#include <linux/fs.h>
+#include <linux/miscdevice.h>
+#include <linux/hrtimer.h>
+#include <linux/ktime.h>
+#include <linux/kref.h>
+#include <linux/wait.h>
+#include <linux/poll.h>
+#include <linux/uaccess.h>
+#include <linux/tty.h>
 #include <linux/version.h>
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,9,0)
+# include <linux/sched/types.h>
+#endif
+#include <linux/serial.h>
 #include <linux/serial_core.h>
 #include <linux/serial_8250.h>
 #include <asm/io.h>
 #include <asm/serial.h>
 #include <MEN/men_chameleon.h>
+#include "men_z25_tt.h"
 
 /* activate this to get thorough debug outputs */
 /* #define DBG */
@@ -48,8 +67,12 @@
 #define Z25_MODE_HDX		0x0f	/* differential, half duplex, echo suppressed */
 
 #define MEN_Z25_MAX_SETUP 	64
+#define MEN_Z25_MAX_UNITS 	MEN_Z25_MAX_SETUP
 #define Z25_DRV_NAM		"MEN 13Z025"
 #define MODE_MAX_LEN		255 /* chars of mode */
+#define Z25_TT_DEPTH		16  /* frames/results queued per time triggered device */
+#define Z25_IRQ_PRIO_DEFAULT	(MAX_RT_PRIO/2) /* irq thread prio of UARTs with irq_prio=0,
+						   same as the default of kernel irq threads */
 #ifdef DBG
 #define DBGOUT(x...) printk(x)
 #else
@@ -72,7 +95,7 @@
 # define UART_8250_UNREGISTER_FUNC 	serial8250_unregister_port
 # define UART_8250_IOMEMBASE  		men_uart_port.port.membase
 
-static int G_menZ25Nr;			/**< current number of MEN_Z25 uarts found */
+static int G_menZ25Nr;			/**< number of setup indices handed out so far */
 static int G_menZ25_mode[MEN_Z25_MAX_SETUP];
 
 /*
@@ -93,11 +116,62 @@ static CHAMELEON_DRIVER_T G_driver = {
 	.remove		=	uarts_remove
 };
 
+/**
+ * Record of a unit that has been probed once. It is kept until module
+ * unload, so a unit that is removed (FPGA reload, PCI rescan, unbind)
+ * and probed again gets the same mode/baud_bases entries and, if the
+ * 8250 core permits, the same serial.c lines as before.
+ */
+typedef struct {
+	int  used;				/* record is valid				*/
+	int  domain;				/* PCI location of the FPGA ...		*/
+	unsigned int bus;
+	unsigned int devfn;
+	u16  modCode;				/* ... and unit within the FPGA		*/
+	int  instance;
+	int  idx[4];				/* setup index (mode/baud_bases) per UART
+						   position, -1: not assigned yet 	*/
+	int  line[4];				/* serial.c lines of last probe 	*/
+} MEN_Z25_UNITREC_T;
+
+static MEN_Z25_UNITREC_T G_unitRec[MEN_Z25_MAX_UNITS];
+static DEFINE_MUTEX(G_unitLock);		/**< protects G_unitRec and G_menZ25Nr */
+
+/** time triggered transmit data of a UART (/dev/z25tt<line>) */
+typedef struct {
+	struct miscdevice misc;			/* char device 					*/
+	char name[16];				/* device name z25tt<line> 			*/
+	struct kref ref;			/* held by UART and each open file 		*/
+	struct uart_port *port;			/* 8250 core port, NULL after removal 		*/
+	spinlock_t lock;			/* protects queues and port 			*/
+	struct hrtimer timer;			/* fires at txTime of frame[0] 			*/
+	wait_queue_head_t wq;			/* readers/writers waiting for queue space 	*/
+	MEN_Z25_TT_FRAME_T frame[Z25_TT_DEPTH];	/* queued frames, sorted by txTime 		*/
+	int nFrames;
+	MEN_Z25_TT_STATUS_T status[Z25_TT_DEPTH];	/* ring of results not read yet 	*/
+	int stHead;
+	int stNum;
+} MEN_Z25_TT_T;
+
+/** per UART data, passed to the 8250 core as port.private_data */
+typedef struct {
+	struct kthread_worker worker;		/* worker run by task 				*/
+	struct task_struct *task;		/* own irq thread, NULL: 8250 core handles irq	*/
+	struct kthread_work work;		/* services the UART in worker			*/
+	struct uart_port *port;			/* 8250 core port to service 			*/
+	unsigned int iir;			/* IIR read when the irq was taken 		*/
+	int stopped;				/* port is shut down, don't service/unmask 	*/
+	int afe;				/* UART has auto RTS/CTS (MCR AFE bit) 		*/
+	MEN_Z25_TT_T *tt;			/* time triggered transmit device or NULL 	*/
+} MEN_Z25_PORT_T;
+
 /** this structure is stored as driver_data in chameleon_unit */
 typedef struct {
 	volatile unsigned char *uartBase[4];	/* mapped base addresses of UARTs 		*/
 	volatile unsigned char* modeReg;        /* mapped base addresses of mode register 	*/
 	int  line[4];				/* serial.c lines assigned (for unregister) 	*/
+	int  ioMapped;				/* unit is in an I/O BAR (nothing to unmap) 	*/
+	MEN_Z25_PORT_T port[4];			/* per UART data 				*/
 } MEN_Z25_DRVDATA_T;
 
 /*******************************************************************/
@@ -113,16 +187,798 @@ static int nports = MEN_Z25_MAX_SETUP;
 static ulong baud_base = (33333333/32); /* was magic 1041600 in prev. Revision */
 static ulong baud_bases[MEN_Z25_MAX_SETUP];
 static char *fixed_type = "0";
+static int auto_flow[MEN_Z25_MAX_SETUP];
+static int irq_prio[MEN_Z25_MAX_SETUP];
+static int irq_cpu[MEN_Z25_MAX_SETUP] = { [0 ... MEN_Z25_MAX_SETUP-1] = -1 };
 
 module_param( mode, charp, 0 );
 module_param( baud_base, ulong, 0 );
 module_param_array(baud_bases, ulong, (void*)&nports, 0664 );
 module_param( fixed_type, charp, 0 );
+module_param_array(auto_flow, int, NULL, 0444 );
+module_param_array(irq_prio, int, NULL, 0664 );
+module_param_array(irq_cpu, int, NULL, 0664 );
 
 MODULE_PARM_DESC( mode, "phys. mode for each port e.g.: mode=\"se df_fdx df_hdxe\"" );
 MODULE_PARM_DESC( baud_base, "Base for baudrate generation. Overriden by baud_bases" );
 MODULE_PARM_DESC( baud_bases, "Base for baudrate generation for each port e.g.: baud_bases=1843200,1843200,1041666,1041666. Overrides baud_base" );
 MODULE_PARM_DESC( fixed_type, "UART port fixed_type=0 (autoscan)/fixed_type=1 (PORT_16550A)" );
+MODULE_PARM_DESC( auto_flow, "RTS/CTS flow control for each port e.g.: auto_flow=1,1,0,0. 0 (default): software, 1: hardware if UART has the MCR AFE bit. Only set 1 for UARTs known to implement it" );
+MODULE_PARM_DESC( irq_prio, "SCHED_FIFO priority (1..99) of the own irq thread for each port e.g.: irq_prio=80,0,0,10. If all are 0 (default) irqs are handled by 8250 core, else ports with 0 get priority 50" );
+MODULE_PARM_DESC( irq_cpu, "CPU the irq thread of each port is bound to e.g.: irq_cpu=1,-1,-1,0. -1 (default): any CPU" );
+
+/*******************************************************************/
+/** Get the persistent record of a unit, create it on first probe
+ *
+ * A unit is identified by the PCI location of its FPGA together with
+ * its module code and instance number. Each UART position present in
+ * \a mask gets a setup index (into mode/baud_bases) on its first probe.
+ * Any later probe of the same unit reuses them, so a UART keeps its
+ * index even if other UART positions of the unit appear or vanish.
+ *
+ * \param chu		\IN unit being probed
+ * \param mask		\IN UART positions present (bit 0: first UART)
+ * \return record or NULL when all records are in use
+ */
+static MEN_Z25_UNITREC_T *z25_unit_get( CHAMELEON_UNIT_T *chu, unsigned int mask )
+{
+	MEN_Z25_UNITREC_T *rec, *freeRec = NULL;
+	int domain = pci_domain_nr( chu->pdev->bus );
+	int i, known = 0;
+
+	mutex_lock( &G_unitLock );
+
+	for( i=0; i<MEN_Z25_MAX_UNITS; i++ ) {
+		rec = &G_unitRec[i];
+		if( !rec->used ) {
+			if( !freeRec )
+				freeRec = rec;
+			continue;
+		}
+		if( (rec->domain	== domain) &&
+			(rec->bus	== chu->pdev->bus->number) &&
+			(rec->devfn	== chu->pdev->devfn) &&
+			(rec->modCode	== chu->modCode) &&
+			(rec->instance	== chu->instance) ) {
+			DBGOUT("z25_unit_get: re-probe of unit\n" );
+			known = 1;
+			goto found;
+		}
+	}
+
+	if( (rec = freeRec) == NULL )
+		goto out;
+
+	rec->used	= 1;
+	rec->domain	= domain;
+	rec->bus	= chu->pdev->bus->number;
+	rec->devfn	= chu->pdev->devfn;
+	rec->modCode	= chu->modCode;
+	rec->instance	= chu->instance;
+	for( i=0; i<4; i++ ) {
+		rec->idx[i]  = -1;
+		rec->line[i] = -1;
+	}
+
+found:
+	for( i=0; i<4; i++ ) {
+		if( !(mask & (1 << i)) || (rec->idx[i] >= 0) )
+			continue;
+		rec->idx[i] = G_menZ25Nr++;
+		if( known )
+			printk( KERN_WARNING Z25_DRV_NAM ": new UART %d in re-probed unit gets setup index %d\n",
+					i, rec->idx[i] );
+	}
+out:
+	mutex_unlock( &G_unitLock );
+	return rec;
+}
+
+/*******************************************************************/
+/** Get baud base for the UART with setup index \a idx
+ */
+static ulong z25_baud_base( int idx )
+{
+	if( (idx >= MEN_Z25_MAX_SETUP) || !baud_bases[idx] )
+		return baud_base;
+	return baud_bases[idx];
+}
+
+/*******************************************************************/
+/** Get phys. mode for the UART with setup index \a idx
+ *
+ * Default: RS232 (single ended)
+ */
+static int z25_mode( int idx )
+{
+	if( (idx >= MEN_Z25_MAX_SETUP) || !G_menZ25_mode[idx] )
+		return Z25_MODE_SE;
+	return G_menZ25_mode[idx];
+}
+
+/*******************************************************************/
+/** Remember the line a UART got and warn if it differs from last probe
+ */
+static void z25_line_update( MEN_Z25_UNITREC_T *rec, int i, int line )
+{
+	if( (rec->line[i] >= 0) && (rec->line[i] != line) )
+		printk( KERN_WARNING Z25_DRV_NAM ": UART %d moved from line %d to %d\n",
+				rec->idx[i], rec->line[i], line );
+	rec->line[i] = line;
+}
+
+/*******************************************************************/
+/** 8250 core irq hook for UARTs with an own irq thread
+ *
+ * Called by the 8250 core interrupt handler for each UART on the irq
+ * line. If the UART has an interrupt pending it is masked and its
+ * thread is woken up, so the actual servicing runs with the priority
+ * configured for this UART. Note the thread can only be woken once the
+ * shared 8250 core handler runs; on PREEMPT_RT that is the irq thread of
+ * the line with its own priority.
+ *
+ * \param port	\IN 8250 core port
+ * \return 1 if the UART had an interrupt pending, 0 otherwise
+ */
+static int z25_handle_irq( struct uart_port *port )
+{
+	MEN_Z25_PORT_T *zp = port->private_data;
+	unsigned long flags;
+	unsigned int iir;
+
+	spin_lock_irqsave( &port->lock, flags );
+	iir = serial_port_in( port, UART_IIR );
+	if( (iir & UART_IIR_NO_INT) || zp->stopped ) {
+		spin_unlock_irqrestore( &port->lock, flags );
+		return 0;
+	}
+
+	/* mask UART until its thread has serviced it */
+	serial_port_out( port, UART_IER, 0 );
+	zp->iir  = iir;
+	zp->port = port;
+	spin_unlock_irqrestore( &port->lock, flags );
+
+	kthread_queue_work( &zp->worker, &zp->work );
+	return 1;
+}
+
+/*******************************************************************/
+/** Irq thread work of a UART
+ *
+ * Services the UART through the 8250 core and unmasks it again.
+ * The 8250 core keeps the wanted IER value in up->ier. Nothing is done
+ * once z25_shutdown() has stopped the port.
+ */
+static void z25_irq_work( struct kthread_work *work )
+{
+	MEN_Z25_PORT_T *zp = container_of( work, MEN_Z25_PORT_T, work );
+	struct uart_port *port = zp->port;
+	unsigned long flags;
+	int stopped;
+
+	spin_lock_irqsave( &port->lock, flags );
+	stopped = zp->stopped;
+	spin_unlock_irqrestore( &port->lock, flags );
+	if( stopped )
+		return;
+
+	serial8250_handle_irq( port, zp->iir );
+
+	spin_lock_irqsave( &port->lock, flags );
+	if( !zp->stopped )
+		serial_port_out( port, UART_IER, up_to_u8250p( port )->ier );
+	spin_unlock_irqrestore( &port->lock, flags );
+}
+
+/*******************************************************************/
+/** 8250 core startup hook
+ *
+ * Installed for all UARTs, see z25_port_unhook().
+ */
+static int z25_startup( struct uart_port *port )
+{
+	MEN_Z25_PORT_T *zp = port->private_data;
+	unsigned long flags;
+
+	if( !zp->task )
+		return serial8250_do_startup( port );
+
+	spin_lock_irqsave( &port->lock, flags );
+	zp->stopped = 0;
+	spin_unlock_irqrestore( &port->lock, flags );
+
+	return serial8250_do_startup( port );
+}
+
+/*******************************************************************/
+/** 8250 core shutdown hook
+ *
+ * For UARTs with an own irq thread it masks the UART and waits for the
+ * thread, so no queued work touches the UART or IER during or after the
+ * 8250 core shutdown. Installed for all UARTs, see z25_port_unhook().
+ */
+static void z25_shutdown( struct uart_port *port )
+{
+	MEN_Z25_PORT_T *zp = port->private_data;
+	unsigned long flags;
+
+	if( !zp->task ) {
+		serial8250_do_shutdown( port );
+		return;
+	}
+
+	spin_lock_irqsave( &port->lock, flags );
+	zp->stopped = 1;
+	serial_port_out( port, UART_IER, 0 );
+	spin_unlock_irqrestore( &port->lock, flags );
+
+	kthread_flush_work( &zp->work );
+
+	serial8250_do_shutdown( port );
+}
+
+/*******************************************************************/
+/** Check if own irq threads are requested for any UART
+ *
+ * The 8250 core handler can only wake a thread after servicing all
+ * UARTs ahead on the irq line. So if one UART has an own thread, all
+ * UARTs get one and the core handler only has to mask them.
+ */
+static int z25_irq_threaded( void )
+{
+	int i;
+
+	for( i=0; i<MEN_Z25_MAX_SETUP; i++ )
+		if( irq_prio[i] > 0 )
+			return 1;
+	return 0;
+}
+
+/*******************************************************************/
+/** Create own irq thread for a UART if requested by irq_prio
+ *
+ * UARTs with irq_prio=0 get Z25_IRQ_PRIO_DEFAULT if any UART has an
+ * own thread. On failure the UART is left to the 8250 core irq handler.
+ *
+ * The thread is created stopped, so its priority and CPU are set before
+ * it runs the first time. This works the same on all kernels, whereas
+ * kthread_create_worker() wakes the thread only before 6.14.
+ *
+ * \param up		\IN port to register, irq hooks are set here
+ * \param zp		\IN per UART data
+ * \param idx		\IN setup index of UART
+ */
+static void z25_irq_thread_init( struct UART_8250_PORT_STRUCT *up,
+								 MEN_Z25_PORT_T *zp, int idx )
+{
+	struct task_struct *task;
+	int prio, cpu;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,9,0)
+	struct sched_attr attr;
+#else
+	struct sched_param param;
+#endif
+
+	zp->task	= NULL;
+	zp->stopped	= 1;
+
+	/* always installed, they fall back to the 8250 core without thread */
+	up->port.startup	= z25_startup;
+	up->port.shutdown	= z25_shutdown;
+
+	if( !z25_irq_threaded() )
+		return;
+
+	if( (idx < MEN_Z25_MAX_SETUP) && (irq_prio[idx] > 0) )
+		prio = min( irq_prio[idx], MAX_RT_PRIO-1 );
+	else
+		prio = Z25_IRQ_PRIO_DEFAULT;
+	cpu = (idx < MEN_Z25_MAX_SETUP) ? irq_cpu[idx] : -1;
+
+	kthread_init_worker( &zp->worker );
+	kthread_init_work( &zp->work, z25_irq_work );
+
+	task = kthread_create( kthread_worker_fn, &zp->worker, "irq/z25-%d", idx );
+	if( IS_ERR( task )) {
+		printk( KERN_ERR "*** " Z25_DRV_NAM ": can't create irq thread for UART %d\n", idx );
+		return;
+	}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,9,0)
+	memset( &attr, 0, sizeof(attr));
+	attr.size		= sizeof(attr);
+	attr.sched_policy	= SCHED_FIFO;
+	attr.sched_priority	= prio;
+	sched_setattr_nocheck( task, &attr );
+#else
+	param.sched_priority	= prio;
+	sched_setscheduler_nocheck( task, SCHED_FIFO, &param );
+#endif
+
+	if( (cpu >= 0) && (cpu < nr_cpu_ids) && cpu_online( cpu ))
+		kthread_bind( task, cpu );
+	else if( cpu >= 0 )
+		printk( KERN_WARNING Z25_DRV_NAM ": UART %d: CPU %d not online, irq thread not bound\n", idx, cpu );
+
+	wake_up_process( task );
+	zp->task = task;
+
+	DBGOUT(KERN_INFO "UART %d: irq thread prio=%d cpu=%d\n", idx, prio, cpu );
+	up->port.handle_irq	= z25_handle_irq;
+}
+
+/*******************************************************************/
+/** Stop own irq thread of a UART, if any
+ *
+ * Must be called after the port is unregistered from the 8250 core.
+ * Unregistering shuts the port down, z25_shutdown() has then flushed
+ * all work of the thread already.
+ */
+static void z25_irq_thread_exit( MEN_Z25_PORT_T *zp )
+{
+	if( zp->task ) {
+		kthread_flush_worker( &zp->worker );
+		kthread_stop( zp->task );
+		zp->task = NULL;
+	}
+}
+
+/*******************************************************************/
+/** Remove this driver's hooks from the 8250 core port of \a line
+ *
+ * Must be called after serial8250_unregister_port(). The 8250 core keeps
+ * the hooks in its port table, and a later registration of the same
+ * slot only replaces hooks that are set. Without this they would point
+ * into this module after it is unloaded.
+ */
+static void z25_port_unhook( int line )
+{
+	struct UART_8250_PORT_STRUCT *up = serial8250_get_port( line );
+
+	up->port.startup	= NULL;
+	up->port.shutdown	= NULL;
+	up->port.set_termios	= NULL;
+}
+
+/*******************************************************************/
+/** Check if a UART supports automatic RTS/CTS flow control
+ *
+ * UARTs with 16750 style auto flow control implement the AFE bit in
+ * MCR, on plain 16550 UARTs this bit always reads back as 0. Some FPGA
+ * cores store the bit without function though, so this is only done
+ * for UARTs enabled in auto_flow.
+ *
+ * \param base		\IN UART base address (I/O port or mapped memory)
+ * \param ioMapped	\IN base is an I/O port
+ * \param idx		\IN setup index of UART
+ * \return 1 if AFE bit is implemented, 0 otherwise
+ */
+static int z25_afe_detect( volatile unsigned char *base, int ioMapped, int idx )
+{
+	unsigned char mcr, val;
+
+	if( (idx >= MEN_Z25_MAX_SETUP) || !auto_flow[idx] )
+		return 0;
+
+	mcr = MEN_Z25_READB( base + UART_MCR );
+	MEN_Z25_WRITEB( mcr | UART_MCR_AFE, base + UART_MCR );
+	val = MEN_Z25_READB( base + UART_MCR );
+	MEN_Z25_WRITEB( mcr, base + UART_MCR );
+
+	return (val & UART_MCR_AFE) ? 1 : 0;
+}
+
+/*******************************************************************/
+/** 8250 core set_termios hook
+ *
+ * For UARTs with auto RTS/CTS it enables the hardware flow control in
+ * MCR if CRTSCTS is set. The 8250 core keeps the extra MCR bits in
+ * up->mcr, so they survive later modem control changes. With
+ * UPSTAT_AUTOCTS set the serial core leaves stopping the transmitter on
+ * CTS to the UART. Installed for all UARTs, see z25_port_unhook().
+ */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,1,0)
+static void z25_set_termios( struct uart_port *port, struct ktermios *termios,
+							 const struct ktermios *old )
+#else
+static void z25_set_termios( struct uart_port *port, struct ktermios *termios,
+							 struct ktermios *old )
+#endif
+{
+	struct UART_8250_PORT_STRUCT *up = up_to_u8250p( port );
+	MEN_Z25_PORT_T *zp = port->private_data;
+	unsigned long flags;
+
+	serial8250_do_set_termios( port, termios, old );
+
+	if( !zp->afe )
+		return;
+
+	spin_lock_irqsave( &port->lock, flags );
+	if( termios->c_cflag & CRTSCTS ) {
+		up->mcr |= UART_MCR_AFE;
+#ifdef UPSTAT_AUTOCTS
+		port->status |= UPSTAT_AUTOCTS;
+#endif
+	} else {
+		up->mcr &= ~UART_MCR_AFE;
+#ifdef UPSTAT_AUTOCTS
+		port->status &= ~UPSTAT_AUTOCTS;
+#endif
+	}
+	port->ops->set_mctrl( port, port->mctrl );
+	spin_unlock_irqrestore( &port->lock, flags );
+}
+
+/*******************************************************************/
+/** Enable hardware RTS/CTS for a UART if supported
+ *
+ * If not supported or not enabled in auto_flow, CRTSCTS is handled in
+ * software by the serial core as before.
+ *
+ * \param up		\IN port to register, set_termios is set here (always,
+ *			see z25_port_unhook())
+ * \param zp		\IN per UART data
+ * \param base		\IN UART base address (I/O port or mapped memory)
+ * \param ioMapped	\IN base is an I/O port
+ * \param idx		\IN setup index of UART
+ */
+static void z25_afe_init( struct UART_8250_PORT_STRUCT *up, MEN_Z25_PORT_T *zp,
+						  volatile unsigned char *base, int ioMapped, int idx )
+{
+	/* always installed, it leaves CRTSCTS to the serial core without AFE */
+	up->port.set_termios = z25_set_termios;
+
+	zp->afe = z25_afe_detect( base, ioMapped, idx );
+	if( zp->afe )
+		printk( KERN_INFO Z25_DRV_NAM ": UART %d: hardware RTS/CTS flow control\n", idx );
+}
+
+/*******************************************************************/
+/** Release time triggered transmit data when last user is gone
+ */
+static void z25_tt_free( struct kref *ref )
+{
+	kfree( container_of( ref, MEN_Z25_TT_T, ref ));
+}
+
+/*******************************************************************/
+/** Put a frame into the TX FIFO of the UART
+ *
+ * The frame is only sent if the whole transmitter (TX FIFO and shift
+ * register, LSR TEMT) is empty. So all bytes are loaded at once and the
+ * first one starts right at the launch time, not after the last character
+ * of a previous frame.
+ *
+ * \param tt		\IN time triggered transmit data of UART
+ * \param f		\IN frame to send
+ * \param st		\OUT result
+ */
+static void z25_tt_launch( MEN_Z25_TT_T *tt, MEN_Z25_TT_FRAME_T *f,
+						   MEN_Z25_TT_STATUS_T *st )
+{
+	struct uart_port *port = tt->port;
+	struct UART_8250_PORT_STRUCT *up = up_to_u8250p( port );
+	unsigned int lsr;
+	u64 now;
+	int i;
+
+	spin_lock( &port->lock );
+
+	now = ktime_get_ns();
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,9,0)
+	if( !tty_port_initialized( &port->state->port ))
+#else
+	if( !test_bit( ASYNCB_INITIALIZED, &port->state->port.flags ))
+#endif
+		st->status = -EIO;
+	else {
+		lsr = serial_port_in( port, UART_LSR );
+		up->lsr_saved_flags |= lsr & LSR_SAVE_FLAGS;
+
+		if( !(lsr & UART_LSR_TEMT) )
+			st->status = -EBUSY;
+		else {
+			now = ktime_get_ns();
+			for( i=0; i<f->len; i++ )
+				serial_port_out( port, UART_TX, f->data[i] );
+			st->status = 0;
+		}
+	}
+
+	spin_unlock( &port->lock );
+
+	st->txTime	= f->txTime;
+	st->launchTime	= now;
+	st->lateness	= (s64)(now - f->txTime);
+	st->id		= f->id;
+}
+
+/*******************************************************************/
+/** hrtimer function: send the first queued frame when due
+ */
+static enum hrtimer_restart z25_tt_timer( struct hrtimer *timer )
+{
+	MEN_Z25_TT_T *tt = container_of( timer, MEN_Z25_TT_T, timer );
+	MEN_Z25_TT_STATUS_T *st;
+	unsigned long flags;
+	int wake = 0;
+
+	spin_lock_irqsave( &tt->lock, flags );
+
+	/* txTime <= KTIME_MAX is checked in z25_tt_write() */
+	if( tt->nFrames && (ns_to_ktime( tt->frame[0].txTime ) <= ktime_get()) ) {
+		/* oldest unread result is overwritten if nobody reads */
+		if( tt->stNum == Z25_TT_DEPTH ) {
+			tt->stHead = (tt->stHead + 1) % Z25_TT_DEPTH;
+			tt->stNum--;
+		}
+		st = &tt->status[(tt->stHead + tt->stNum) % Z25_TT_DEPTH];
+		z25_tt_launch( tt, &tt->frame[0], st );
+		tt->stNum++;
+
+		tt->nFrames--;
+		memmove( &tt->frame[0], &tt->frame[1], tt->nFrames * sizeof(tt->frame[0]) );
+		wake = 1;
+	}
+
+	if( tt->nFrames )
+		hrtimer_start( &tt->timer, ns_to_ktime( tt->frame[0].txTime ), HRTIMER_MODE_ABS );
+
+	spin_unlock_irqrestore( &tt->lock, flags );
+
+	if( wake )
+		wake_up_interruptible( &tt->wq );
+
+	return HRTIMER_NORESTART;
+}
+
+static int z25_tt_open( struct inode *inode, struct file *file )
+{
+	MEN_Z25_TT_T *tt = container_of( file->private_data, MEN_Z25_TT_T, misc );
+
+	/* misc_open() holds misc_mtx, so tt can't be deregistered meanwhile */
+	kref_get( &tt->ref );
+	file->private_data = tt;
+	return nonseekable_open( inode, file );
+}
+
+static int z25_tt_release( struct inode *inode, struct file *file )
+{
+	MEN_Z25_TT_T *tt = file->private_data;
+
+	kref_put( &tt->ref, z25_tt_free );
+	return 0;
+}
+
+/*******************************************************************/
+/** Queue a frame (MEN_Z25_TT_FRAME_T) for sending at its txTime
+ *
+ * Frames are kept sorted by txTime. A frame is only sent if the
+ * transmitter is empty at its txTime, so frames must be spaced at least
+ * by the time the previous frame needs on the line. Otherwise (e.g.
+ * equal txTime) the later frame is dropped with status -EBUSY. The count
+ * written must cover the header and len data bytes and must not exceed
+ * sizeof(MEN_Z25_TT_FRAME_T). txTime must not exceed KTIME_MAX. Blocks while the queue is full unless
+ * O_NONBLOCK is set.
+ */
+static ssize_t z25_tt_write( struct file *file, const char __user *buf,
+							 size_t count, loff_t *ppos )
+{
+	MEN_Z25_TT_T *tt = file->private_data;
+	size_t hdrLen = offsetof( MEN_Z25_TT_FRAME_T, data );
+	MEN_Z25_TT_FRAME_T f;
+	unsigned long flags;
+	int pos;
+
+	if( (count < hdrLen) || (count > sizeof(f)) )
+		return -EINVAL;
+
+	memset( &f, 0, sizeof(f) );
+	if( copy_from_user( &f, buf, count ))
+		return -EFAULT;
+
+	if( !f.len || (f.len > Z25_TT_MAX_DATA) || (count < hdrLen + f.len) )
+		return -EINVAL;
+
+	/* larger values would be a negative, always expired ktime_t */
+	if( f.txTime > KTIME_MAX )
+		return -EINVAL;
+
+	spin_lock_irqsave( &tt->lock, flags );
+	for(;;) {
+		if( !tt->port ) {
+			spin_unlock_irqrestore( &tt->lock, flags );
+			return -ENODEV;
+		}
+		/* whole frame must be loadable into the TX FIFO at once */
+		if( f.len > up_to_u8250p( tt->port )->tx_loadsz ) {
+			spin_unlock_irqrestore( &tt->lock, flags );
+			return -EMSGSIZE;
+		}
+		if( tt->nFrames < Z25_TT_DEPTH )
+			break;
+
+		spin_unlock_irqrestore( &tt->lock, flags );
+		if( file->f_flags & O_NONBLOCK )
+			return -EAGAIN;
+		if( wait_event_interruptible( tt->wq, (tt->nFrames < Z25_TT_DEPTH) || !tt->port ))
+			return -ERESTARTSYS;
+		spin_lock_irqsave( &tt->lock, flags );
+	}
+
+	for( pos=tt->nFrames; (pos > 0) && (tt->frame[pos-1].txTime > f.txTime); pos-- )
+		;
+	memmove( &tt->frame[pos+1], &tt->frame[pos], (tt->nFrames - pos) * sizeof(f) );
+	tt->frame[pos] = f;
+	tt->nFrames++;
+
+	if( pos == 0 )
+		hrtimer_start( &tt->timer, ns_to_ktime( f.txTime ), HRTIMER_MODE_ABS );
+
+	spin_unlock_irqrestore( &tt->lock, flags );
+	return count;
+}
+
+/*******************************************************************/
+/** Read results (MEN_Z25_TT_STATUS_T) of sent frames
+ *
+ * Returns as many results as fit into the buffer. Blocks until one
+ * is available unless O_NONBLOCK is set.
+ */
+static ssize_t z25_tt_read( struct file *file, char __user *buf,
+							size_t count, loff_t *ppos )
+{
+	MEN_Z25_TT_T *tt = file->private_data;
+	MEN_Z25_TT_STATUS_T st;
+	unsigned long flags;
+	size_t done = 0;
+
+	if( count < sizeof(st) )
+		return -EINVAL;
+
+	if( !(file->f_flags & O_NONBLOCK) &&
+		wait_event_interruptible( tt->wq, tt->stNum || !tt->port ))
+		return -ERESTARTSYS;
+
+	while( done + sizeof(st) <= count ) {
+		spin_lock_irqsave( &tt->lock, flags );
+		if( !tt->stNum ) {
+			spin_unlock_irqrestore( &tt->lock, flags );
+			break;
+		}
+		st = tt->status[tt->stHead];
+		tt->stHead = (tt->stHead + 1) % Z25_TT_DEPTH;
+		tt->stNum--;
+		spin_unlock_irqrestore( &tt->lock, flags );
+
+		if( copy_to_user( buf + done, &st, sizeof(st) ))
+			return done ? done : -EFAULT;
+		done += sizeof(st);
+	}
+
+	if( !done )
+		return tt->port ? -EAGAIN : -ENODEV;
+
+	return done;
+}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,16,0)
+# define Z25_POLL_T		__poll_t
+# define Z25_POLL_IN		(EPOLLIN | EPOLLRDNORM)
+# define Z25_POLL_OUT		(EPOLLOUT | EPOLLWRNORM)
+# define Z25_POLL_HUP		EPOLLHUP
+#else
+# define Z25_POLL_T		unsigned int
+# define Z25_POLL_IN		(POLLIN | POLLRDNORM)
+# define Z25_POLL_OUT		(POLLOUT | POLLWRNORM)
+# define Z25_POLL_HUP		POLLHUP
+#endif
+
+static Z25_POLL_T z25_tt_poll( struct file *file, poll_table *wait )
+{
+	MEN_Z25_TT_T *tt = file->private_data;
+	Z25_POLL_T mask = 0;
+	unsigned long flags;
+
+	poll_wait( file, &tt->wq, wait );
+
+	spin_lock_irqsave( &tt->lock, flags );
+	if( tt->stNum )
+		mask |= Z25_POLL_IN;
+	if( tt->nFrames < Z25_TT_DEPTH )
+		mask |= Z25_POLL_OUT;
+	if( !tt->port )
+		mask |= Z25_POLL_HUP;
+	spin_unlock_irqrestore( &tt->lock, flags );
+
+	return mask;
+}
+
+static const struct file_operations G_ttFops = {
+	.owner		= THIS_MODULE,
+	.open		= z25_tt_open,
+	.release	= z25_tt_release,
+	.read		= z25_tt_read,
+	.write		= z25_tt_write,
+	.poll		= z25_tt_poll,
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6,12,0)
+	.llseek		= no_llseek,
+#endif
+};
+
+/*******************************************************************/
+/** Create time triggered transmit device /dev/z25tt<line> of a UART
+ *
+ * The device is optional, the UART works without it.
+ *
+ * \param zp		\IN per UART data
+ * \param line		\IN serial.c line of UART
+ */
+static void z25_tt_init( MEN_Z25_PORT_T *zp, int line )
+{
+	MEN_Z25_TT_T *tt;
+
+	zp->tt = NULL;
+
+	tt = kzalloc( sizeof(*tt), GFP_KERNEL );
+	if( !tt ) {
+		printk( KERN_ERR "*** " Z25_DRV_NAM ": no mem for z25tt%d\n", line );
+		return;
+	}
+
+	kref_init( &tt->ref );
+	spin_lock_init( &tt->lock );
+	init_waitqueue_head( &tt->wq );
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,13,0)
+	hrtimer_setup( &tt->timer, z25_tt_timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS );
+#else
+	hrtimer_init( &tt->timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS );
+	tt->timer.function = z25_tt_timer;
+#endif
+	tt->port = &serial8250_get_port( line )->port;
+
+	snprintf( tt->name, sizeof(tt->name), "z25tt%d", line );
+	tt->misc.minor	= MISC_DYNAMIC_MINOR;
+	tt->misc.name	= tt->name;
+	tt->misc.fops	= &G_ttFops;
+
+	if( misc_register( &tt->misc ) < 0 ) {
+		printk( KERN_ERR "*** " Z25_DRV_NAM ": can't register %s\n", tt->name );
+		kfree( tt );
+		return;
+	}
+	zp->tt = tt;
+}
+
+/*******************************************************************/
+/** Remove time triggered transmit device of a UART, if any
+ *
+ * Queued frames are dropped. Users still having the device open get
+ * -ENODEV, the data is freed on their last close.
+ */
+static void z25_tt_exit( MEN_Z25_PORT_T *zp )
+{
+	MEN_Z25_TT_T *tt = zp->tt;
+	unsigned long flags;
+
+	if( !tt )
+		return;
+
+	misc_deregister( &tt->misc );
+
+	spin_lock_irqsave( &tt->lock, flags );
+	tt->port	= NULL;
+	tt->nFrames	= 0;
+	spin_unlock_irqrestore( &tt->lock, flags );
+
+	hrtimer_cancel( &tt->timer );
+	wake_up_interruptible( &tt->wq );
+
+	kref_put( &tt->ref, z25_tt_free );
+	zp->tt = NULL;
+}
 
 /*******************************************************************/
 /** PNP function for 16Z025 Quad UART
@@ -131,25 +987,27 @@ MODULE_PARM_DESC( fixed_type, "UART port fixed_type=0 (autoscan)/fixed_type=1 (P
  * is called for each Z25 unit. The Function searches in base+0x40 for
  * the 1-4 implemented UARTs
  *
- * \param chu	\IN 	z25 unit found
+ * \param chu		\IN 	z25 unit found
+ * \param fixedBase	\IN 	baud base for all UARTs of the unit
+ *				or 0 to take it from baud_bases
  * \return 		0 on success or negative linux error number
  */
-static int z25_probe( CHAMELEON_UNIT_T *chu )
+static int z25_probe( CHAMELEON_UNIT_T *chu, ulong fixedBase )
 {
 	unsigned char *uart_physbase;
 	unsigned char *iomemP;
 	struct UART_8250_PORT_STRUCT   men_uart_port;
 	unsigned char exist_mask, b;
-	int line, i, ioMapped;
+	int line, i, ioMapped, idx;
 	MEN_Z25_DRVDATA_T *drvData;
+	MEN_Z25_UNITREC_T *rec;
 
 	uart_physbase = (unsigned char *)chu->phys;
 
-	DBGOUT("z125_probe: physBase=%p irq=%d baud_base=%d\n",
-		   uart_physbase, chu->irq, baud_bases[G_menZ25Nr] );
+	DBGOUT("z25_probe: physBase=%p irq=%d\n", uart_physbase, chu->irq );
 
 	/*--- get storage for intermediate data ---*/
-	drvData = kmalloc( sizeof(MEN_Z25_DRVDATA_T), GFP_KERNEL );
+	drvData = kzalloc( sizeof(MEN_Z25_DRVDATA_T), GFP_KERNEL );
 	chu->driver_data = drvData;
 
 	if( !drvData ) {
@@ -159,6 +1017,7 @@ static int z25_probe( CHAMELEON_UNIT_T *chu )
 
 	/*--- are we io-mapped ? ---*/
 	ioMapped = pci_resource_flags( chu->pdev, chu->bar ) & IORESOURCE_IO;
+	drvData->ioMapped = ioMapped;
 	DBGOUT( "bar=%d ioMapped=0x%x\n", chu->bar, ioMapped );
 
 	if( ioMapped )
@@ -172,6 +1031,16 @@ static int z25_probe( CHAMELEON_UNIT_T *chu )
 	exist_mask = MEN_Z25_READB(drvData->modeReg) & 0xf0;
 	DBGOUT( "Z25 exist_mask=0x%x\n", exist_mask );
 
+	rec = z25_unit_get( chu, exist_mask >> 4 );
+	if( !rec ) {
+		printk( KERN_ERR "*** z25_probe: too many units!\n");
+		if( !ioMapped )
+			iounmap( drvData->modeReg );
+		kfree( drvData );
+		chu->driver_data = NULL;
+		return -ENOSPC;
+	}
+
 	for( i=0, b=0x10; i<4; ++i, b<<=1 ) {
 
 		DBGOUT(KERN_INFO Z25_DRV_NAM ": z25_probe run %d:\n", i );
@@ -179,9 +1048,10 @@ static int z25_probe( CHAMELEON_UNIT_T *chu )
 
 		if( exist_mask & b ) {
 			int modeval;
+			idx = rec->idx[i];
 			memset( &men_uart_port, 0, sizeof(men_uart_port));
 			men_uart_port.port.irq 	   		= chu->irq;
-			men_uart_port.port.uartclk 		= baud_bases[G_menZ25Nr] * 16 ;
+			men_uart_port.port.uartclk 		= (fixedBase ? fixedBase : z25_baud_base(idx)) * 16 ;
 			men_uart_port.port.flags		= UPF_SKIP_TEST|UPF_SHARE_IRQ|UPF_BOOT_AUTOCONF;
 
 			if( ioMapped ) {
@@ -200,12 +1070,9 @@ static int z25_probe( CHAMELEON_UNIT_T *chu )
 				DBGOUT(KERN_INFO "men_uart_port.membase=0x%08x .mapbase=0x%08x\n", men_uart_port.port.membase, men_uart_port.port.mapbase );
 			}
 			/* set differential mode and half duplex mode according to kernel parameter. Default: RS232 (single ended) */
-			if(( G_menZ25Nr >= MEN_Z25_MAX_SETUP ) || ( !G_menZ25_mode[G_menZ25Nr] ))
-				modeval = Z25_MODE_SE;
-			else
-				modeval = G_menZ25_mode[G_menZ25Nr];
+			modeval = z25_mode( idx );
 
-			DBGOUT(KERN_INFO "16Z025 channel %d: mode=0x%02x\n", G_menZ25Nr, modeval );
+			DBGOUT(KERN_INFO "16Z025 channel %d: mode=0x%02x\n", idx, modeval );
 			MEN_Z25_WRITEB( modeval, UART_8250_IOMEMBASE + 0x07);
 
 			if( strcmp( fixed_type, "0" ) ) {
@@ -214,11 +1081,21 @@ static int z25_probe( CHAMELEON_UNIT_T *chu )
 				men_uart_port.port.type = PORT_16550A;
 			}
 
+			men_uart_port.port.private_data = &drvData->port[i];
+			z25_irq_thread_init( &men_uart_port, &drvData->port[i], idx );
+			z25_afe_init( &men_uart_port, &drvData->port[i],
+						  ioMapped ? uart_physbase + i*0x10 : drvData->uartBase[i],
+						  ioMapped, idx );
+
 			if ((line = UART_8250_REGISTER_FUNC( &men_uart_port )) < 0) {
-				printk( KERN_ERR "*** UART registering for 16Z025 UART %d failed\n", G_menZ25Nr);
+				printk( KERN_ERR "*** UART registering for 16Z025 UART %d failed\n", idx);
+				z25_irq_thread_exit( &drvData->port[i] );
+				if( !ioMapped )
+					iounmap( drvData->uartBase[i] );
 			} else {
 				drvData->line[i] = line;
-				G_menZ25Nr++;
+				z25_line_update( rec, i, line );
+				z25_tt_init( &drvData->port[i], line );
 			}
 		}
 	}
@@ -239,19 +1116,19 @@ static int z125_probe( CHAMELEON_UNIT_T *chu )
 {
 	void *uart_physbase;
 	int modeval=0, ioMapped=0;
-	int line = 0;
+	int i, idx, line = 0;
 
 	struct UART_8250_PORT_STRUCT   men_uart_port;
 
 	MEN_Z25_DRVDATA_T *drvData;
+	MEN_Z25_UNITREC_T *rec;
 
 	uart_physbase = chu->phys;
 
-	DBGOUT("z125_probe: physBase=%p irq=%d baud_base=%d\n",
-		   uart_physbase, chu->irq, baud_bases[G_menZ25Nr] );
+	DBGOUT("z125_probe: physBase=%p irq=%d\n", uart_physbase, chu->irq );
 
 	/*--- get storage for intermediate data ---*/
-	drvData = kmalloc( sizeof(*drvData), GFP_KERNEL );
+	drvData = kzalloc( sizeof(*drvData), GFP_KERNEL );
 	chu->driver_data = drvData;
 
 	if( !drvData ) {
@@ -259,16 +1136,27 @@ static int z125_probe( CHAMELEON_UNIT_T *chu )
 		return -ENOMEM;
 	}
 
-	drvData->line[0] = -1;	/* no serial dev number assigned */
+	for( i=0; i<4; i++ )
+		drvData->line[i] = -1;	/* no serial dev number assigned */
+
+	rec = z25_unit_get( chu, 0x1 );
+	if( !rec ) {
+		printk( KERN_ERR "*** z125_probe: too many units!\n");
+		kfree( drvData );
+		chu->driver_data = NULL;
+		return -ENOSPC;
+	}
+	idx = rec->idx[0];
 
 	/*--- are we io-mapped ? ---*/
 	ioMapped = pci_resource_flags( chu->pdev, chu->bar ) & IORESOURCE_IO;
+	drvData->ioMapped = ioMapped;
 	DBGOUT( "bar=%d ioMapped=0x%x\n", chu->bar, ioMapped );
 
 	memset( &men_uart_port, 0, sizeof(men_uart_port));
 
 	men_uart_port.port.irq 	   		= chu->irq;
-	men_uart_port.port.uartclk 		= baud_bases[G_menZ25Nr] * 16 ;
+	men_uart_port.port.uartclk 		= z25_baud_base( idx ) * 16 ;
 	men_uart_port.port.flags		= UPF_SKIP_TEST|UPF_SHARE_IRQ|UPF_BOOT_AUTOCONF;
 
 	if( ioMapped ) {
@@ -293,10 +1181,7 @@ static int z125_probe( CHAMELEON_UNIT_T *chu )
 	 * set differential mode and half duplex mode according to kernel parameter. Default:
 	 * RS232 (single ended)
 	 */
-	if(( G_menZ25Nr >= MEN_Z25_MAX_SETUP) || (!G_menZ25_mode[G_menZ25Nr]))
-		modeval = Z25_MODE_SE;
-	else
-		modeval = G_menZ25_mode[G_menZ25Nr];
+	modeval = z25_mode( idx );
 
 	DBGOUT(KERN_INFO "16Z125 instance %d: mode=0x%02x\n", chu->instance, modeval );
 	MEN_Z25_WRITEB( modeval, UART_8250_IOMEMBASE + 0x07);
@@ -307,15 +1192,23 @@ static int z125_probe( CHAMELEON_UNIT_T *chu )
 		men_uart_port.port.type = PORT_16550A;
 	}
 
+	men_uart_port.port.private_data = &drvData->port[0];
+	z25_irq_thread_init( &men_uart_port, &drvData->port[0], idx );
+	z25_afe_init( &men_uart_port, &drvData->port[0],
+				  ioMapped ? uart_physbase : drvData->uartBase[0], ioMapped, idx );
+
 	if ((line = UART_8250_REGISTER_FUNC( &men_uart_port )) < 0) {
-		printk( KERN_ERR "*** register_serial() for 16Z125 UART %d failed\n", G_menZ25Nr);
+		printk( KERN_ERR "*** register_serial() for 16Z125 UART %d failed\n", idx);
+		z25_irq_thread_exit( &drvData->port[0] );
+		if( !ioMapped )
+			iounmap( drvData->uartBase[0] );
 	} else {
 		DBGOUT(KERN_INFO "16Z125 instance %d = /dev/ttyS%d\n", chu->instance, line );
 		drvData->line[0] = line;
+		z25_line_update( rec, 0, line );
+		z25_tt_init( &drvData->port[0], line );
 	}
 
-	G_menZ25Nr++;
-
 	return 0;
 }
 
@@ -326,6 +1219,10 @@ static int z125_probe( CHAMELEON_UNIT_T *chu )
  * is called for each Z25/Z125 unit. The Function calls the specific
  * Registration depending if a Z25 or Z125 is found.
  *
+ * It is also called again for a unit that has been removed before
+ * (FPGA reload, PCI rescan, unbind/bind). The UARTs of such a unit
+ * get the same mode and baud base as on first probe.
+ *
  * \param chu	\IN 	z25 unit found
  * \return 		0 on success or negative linux error number
  */
@@ -340,20 +1237,19 @@ static int uarts_probe( CHAMELEON_UNIT_T *chu )
 	 */
 	retval = pci_enable_device(chu->pdev);
 	if ( retval < 0) {
-		printk(KERN_ERR " *** %s: error while pci_enable_device()\n");
+		printk(KERN_ERR " *** %s: error while pci_enable_device()\n", G_driver.name);
 		return retval;
 	}
 
 	switch (chu->modCode){
 	case CHAMELEON_16Z025_UART:
 		DBGOUT(KERN_INFO "Probing Z25 unit\n");
-		retval 		= 	z25_probe(chu);
+		retval 		= 	z25_probe(chu, 0);
 		break;
 
 	case CHAMELEON_16Z057_UART:
 		printk(KERN_INFO "Probing Z57 unit - override baud_base with 115200!\n");
-		baud_bases[G_menZ25Nr]	=	115200;
-		retval 		= 	z25_probe(chu);
+		retval 		= 	z25_probe(chu, 115200);
 		break;
 
 	case CHAMELEON_16Z125_UART:
@@ -367,13 +1263,16 @@ static int uarts_probe( CHAMELEON_UNIT_T *chu )
 		break;
 	}
 
+	if( retval < 0 )
+		pci_disable_device(chu->pdev);
+
 	return(retval);
 }
 
 /*******************************************************************/
 /** PNP function to remove registered Z25 UARTs
  *
- * \param chu		\IN 16Z025 unit to remove
+ * \param chu		\IN 16Z025/16Z057 unit to remove
  * \return 0 on success or negative linux error number
  */
 static int z25_remove( CHAMELEON_UNIT_T *chu )
@@ -386,11 +1285,16 @@ static int z25_remove( CHAMELEON_UNIT_T *chu )
 	if( drvData ){
 		for( i=0; i<4; i++ ) {
 			if( drvData->line[i] >= 0 ) {
+				z25_tt_exit( &drvData->port[i] );
 				serial8250_unregister_port(drvData->line[i]);
-				iounmap( drvData->uartBase[i] );
+				z25_port_unhook( drvData->line[i] );
+				z25_irq_thread_exit( &drvData->port[i] );
+				if( !drvData->ioMapped )
+					iounmap( drvData->uartBase[i] );
 			}
 		}
-		iounmap( drvData->modeReg );
+		if( !drvData->ioMapped )
+			iounmap( drvData->modeReg );
 		kfree( drvData );
 		chu->driver_data = NULL;
 	}
@@ -398,9 +1302,9 @@ static int z25_remove( CHAMELEON_UNIT_T *chu )
 }
 
 /*******************************************************************/
-/** PNP function to remove registered Z25 UARTs
+/** PNP function to remove registered Z125 UARTs
  *
- * \param chu		\IN frodo unit to remove
+ * \param chu		\IN 16Z125 unit to remove
  * \return 0 on success or negative linux error number
  */
 static int z125_remove( CHAMELEON_UNIT_T *chu )
@@ -411,8 +1315,12 @@ static int z125_remove( CHAMELEON_UNIT_T *chu )
 
 	if( drvData ){
 		if( drvData->line[0] >= 0 ) {
+			z25_tt_exit( &drvData->port[0] );
 			serial8250_unregister_port(drvData->line[0]);
-			iounmap( drvData->uartBase[0] );
+			z25_port_unhook( drvData->line[0] );
+			z25_irq_thread_exit( &drvData->port[0] );
+			if( !drvData->ioMapped )
+				iounmap( drvData->uartBase[0] );
 		}
 		kfree( drvData );
 		chu->driver_data = NULL;
@@ -421,20 +1329,38 @@ static int z125_remove( CHAMELEON_UNIT_T *chu )
 }
 
 /*******************************************************************/
-/** helper to remove UART from kernel during unload
+/** PNP function to remove the UARTs of one unit
+ *
+ * Called for each unit during module unload, and for a single unit
+ * when it goes away (FPGA reload, PCI hot remove, unbind). Only the
+ * UARTs of \a chu are unregistered, all other units keep running.
  *
+ * \param chu		\IN unit to remove
+ * \return 0 on success or negative linux error number
  */
 static int uarts_remove( CHAMELEON_UNIT_T *chu )
 {
-	if (chu->modCode == CHAMELEON_16Z025_UART){
-		return z25_remove(chu);
-	}
-	else if (chu->modCode == CHAMELEON_16Z125_UART) {
-		return z125_remove(chu);
-	}
-	else {
+	/* NULL driver_data: probe failed and already disabled the device */
+	int probed = (chu->driver_data != NULL);
+	int retval;
+
+	switch (chu->modCode){
+	case CHAMELEON_16Z025_UART:
+	case CHAMELEON_16Z057_UART:
+		retval = z25_remove(chu);
+		break;
+
+	case CHAMELEON_16Z125_UART:
+		retval = z125_remove(chu);
+		break;
+
+	default:
 		return -ENODEV;
 	}
+
+	if( probed )
+		pci_disable_device(chu->pdev);
+	return retval;
 }
 
 /*******************************************************************/
@@ -103,6 +103,110 @@
 	modprobe men_lx_frodo mode="se,se,se,se,se"
 	to get the additional UARTs registered.
 
+	\subsection auto_flow Hardware RTS/CTS flow control
+
+	Some FPGA UARTs implement 16750 style automatic flow control. For them
+	hardware flow control can be enabled with the module parameter
+
+	auto_flow=flag,flag,...
+
+	Each entry applies to the nth UART, in the same order as mode and
+	baud_bases. A UART with 1 is checked on probe for the AFE bit in the
+	modem control register. If present, setting CRTSCTS in the termios of
+	the line (e.g. stty crtscts) lets the UART itself stop the transmitter
+	on CTS and drop RTS when its receive FIFO fills up, the serial core no
+	longer does this in software. UARTs using it are reported in the
+	kernel messages.
+
+	The AFE bit check can't tell an implemented feature from a plain
+	register bit, which some FPGA UART cores store without function. On
+	such a UART auto_flow=1 results in no flow control at all. So only set
+	it for the UARTs known to support auto flow control.
+
+	UARTs with 0 (default) and UARTs without the AFE bit keep the software
+	flow control of the serial core. The parameter is only read when the
+	module is loaded.
+
+	\subsection irq_prio Interrupt thread priority and CPU
+
+	By default all UARTs on an interrupt line are serviced by the 8250 core
+	interrupt handler, on PREEMPT_RT kernels by one interrupt thread with the
+	default priority. A UART can get its own interrupt thread instead:
+
+	irq_prio=prio,prio,... \n
+	irq_cpu=cpu,cpu,...
+
+	Each entry applies to the nth UART, in the same order as mode and
+	baud_bases. irq_prio is the SCHED_FIFO priority (1..99) of the thread.
+	If all entries are 0 (default) the 8250 core handler services the
+	UARTs as before. If any entry is set, every UART gets its own thread,
+	UARTs with 0 then run at priority 50. irq_cpu binds the thread to a
+	CPU, -1 (default) allows any CPU.
+
+	The shared 8250 core handler then only masks a UART and wakes its
+	thread, which services the UART and unmasks it again. Among each other
+	the UART threads preempt according to their priorities.
+
+	Limitation: a UART thread can only be woken once the shared 8250 core
+	handler of the interrupt line has run. On PREEMPT_RT kernels that is the
+	interrupt thread irq/<irq>-serial with the default priority 50, which
+	this driver does not change. Any task with a higher priority delays it
+	and so also delays the high priority UART (priority inversion). Raise
+	that thread to at least the highest irq_prio, e.g.:
+
+	chrt -f -p 80 $(pgrep irq/<irq>-serial)
+
+	Other 8250 UARTs sharing the line (not driven by this driver) are still
+	serviced completely in the shared handler, in front of the UART threads.
+
+	The threads are named irq/z25-<n>. Both parameters are also writable in
+	/sys/module/men_lx_z25/parameters/ and take effect when the unit is probed
+	the next time. The priority and CPU of a running thread can be changed with
+	chrt and taskset.
+
+	\n \section tt Time triggered transmit
+
+	For each registered UART the driver creates a device /dev/z25tt<line>,
+	where <line> is the number of the matching /dev/ttyS<line>. It lets an
+	application send frames at absolute CLOCK_MONOTONIC times, e.g. at fixed
+	offsets inside a bus cycle. The structures are defined in men_z25_tt.h.
+
+	- write() queues one MEN_Z25_TT_FRAME_T. The driver holds the frame and
+	  puts it into the TX FIFO from a high resolution timer at txTime. A
+	  frame must fit into what the UART loads into its TX FIFO at once
+	  (usually 16 bytes). The write count must cover the header and the
+	  len data bytes and must not exceed sizeof(MEN_Z25_TT_FRAME_T). Up to
+	  16 frames can be queued, further writes block (or fail with EAGAIN
+	  with O_NONBLOCK). txTime values above KTIME_MAX are rejected.
+	- read() returns one MEN_Z25_TT_STATUS_T per frame: the actual
+	  launch time and the lateness against txTime. A frame is not sent
+	  (status -EBUSY) if the transmitter (TX FIFO or shift register) still
+	  holds data at txTime. So frames must be spaced at least by the time
+	  the previous frame needs on the line, frames with equal txTime are
+	  not sent one after the other.
+	  Results that are not read in time are overwritten.
+	- poll() reports results to read and free queue space.
+
+	The line must be opened and configured (baud rate etc.) via
+	/dev/ttyS<line>, received data is read there too. The application
+	should not write to /dev/ttyS<line> while using time triggered
+	frames. On PREEMPT_RT kernels the timer runs in the ktimers thread,
+	so its priority determines the jitter.
+
+	\n \section hotplug Removal and re-probe of single units
+
+	Each 16Z025, 16Z057 and 16Z125 unit is registered and removed on its
+	own. When the chameleon driver removes a unit (FPGA reload, PCI hot
+	remove or rescan, unbind via sysfs) only the UARTs of this unit are
+	unregistered, all other units keep running. No module reload is needed.
+
+	When the unit is probed again, its UARTs get the same entries of the
+	mode and baud_bases parameters as on first probe. As long as the FPGA
+	is mapped to the same address again, the 8250 core assigns the same
+	/dev/ttySx lines, so the termios settings of these lines are kept too.
+	If a line changes (e.g. the BAR moved after a PCI rescan) a kernel
+	warning is printed.
+
 	\n \section kerparinfo Important kernelparameters and BIOS settings for x86 Boards
 
 	In the current driver Version APIC support (Advanced Peripheral Interrupt Controller)
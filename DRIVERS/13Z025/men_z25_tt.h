@@ -0,0 +1,55 @@
+/***********************  I n c l u d e  -  F i l e  ***********************/
+/*!
+ *        \file  men_z25_tt.h
+ *
+ *      \author  kp/ub/ts
+ *
+ *      \brief   Time triggered transmit interface of the 16Z025/125 UART
+ *               driver (/dev/z25tt<line>)
+ *
+ *    \switches  -
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 2021, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _MEN_Z25_TT_H
+#define _MEN_Z25_TT_H
+
+#include <linux/types.h>
+
+#define Z25_TT_MAX_DATA		64	/**< max. frame length (further limited by TX FIFO load size) */
+
+/** frame to send, written to /dev/z25tt<line> */
+typedef struct {
+	__u64 txTime;			/**< CLOCK_MONOTONIC time [ns] to send frame at */
+	__u32 id;			/**< caller's tag, returned in status 		*/
+	__u16 len;			/**< number of bytes in data 			*/
+	__u16 reserved;
+	__u8  data[Z25_TT_MAX_DATA];	/**< frame data, only len bytes need to be written */
+} MEN_Z25_TT_FRAME_T;
+
+/** result of a sent frame, read from /dev/z25tt<line> */
+typedef struct {
+	__u64 txTime;			/**< requested CLOCK_MONOTONIC time [ns] 		*/
+	__u64 launchTime;		/**< CLOCK_MONOTONIC time [ns] frame was put into FIFO 	*/
+	__s64 lateness;			/**< launchTime - txTime [ns] 				*/
+	__u32 id;			/**< tag of frame 					*/
+	__s32 status;			/**< 0: sent, -EBUSY: transmitter not empty, -EIO: line not open */
+} MEN_Z25_TT_STATUS_T;
+
+#endif /* _MEN_Z25_TT_H */